@@ -0,0 +1,39 @@
+#ifndef ARRAY_ALLOC_H
+#define ARRAY_ALLOC_H
+
+// Private allocation helpers shared by dynamic_array.c and freelist.c.
+
+#include "base.h"
+
+#include <stdalign.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Rounds element_size up to a multiple of stride_align (a power of two, or 0
+// for no padding).
+static inline size_t array_stride(size_t element_size, size_t stride_align)
+{
+	if (stride_align <= 1)
+		return element_size;
+	return (element_size + stride_align - 1) & ~(stride_align - 1);
+}
+
+// realloc for buffers aligned to alignment (a power of two, or 0 for the
+// malloc default). Returns NULL on failure.
+static inline void *array_realloc(void *ptr, size_t old_size, size_t new_size,
+				  size_t alignment)
+{
+	if (alignment <= alignof(max_align_t))
+		return realloc(ptr, new_size);
+
+	// aligned_alloc wants a size that is a multiple of the alignment
+	size_t size = (new_size + alignment - 1) & ~(alignment - 1);
+	void *data = aligned_alloc(alignment, size ? size : alignment);
+	if (data && ptr) {
+		memcpy(data, ptr, old_size < new_size ? old_size : new_size);
+		free(ptr);
+	}
+	return data;
+}
+
+#endif
@@ -0,0 +1,69 @@
+#include "../slotmap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/*
+ * Memory pressure after a spike: a small steady-state population, a burst of
+ * short-lived elements, then removal of the burst and a few new adds. RSS is
+ * sampled at each phase, and once more after sm_compact.
+ */
+
+#define STEADY 1000
+#define SPIKE 1000000
+
+struct payload {
+	double v[8];
+};
+
+static long rss_kib(void)
+{
+	long pages = 0, resident = 0;
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (!f)
+		return -1;
+	if (fscanf(f, "%ld %ld", &pages, &resident) != 2)
+		resident = -1;
+	fclose(f);
+	return resident < 0 ? -1 : resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void report(const char *phase, const slotmap_t *sm)
+{
+	printf("  %-28s dense %8zu   rss %8ld KiB\n", phase,
+	       (size_t)sm_dense_length(sm), rss_kib());
+}
+
+int main(void)
+{
+	printf("=== slotmap compaction ===\n\n");
+
+	slotmap_t *sm = sm_create(sizeof(struct payload));
+	sm_id_t *spike = malloc(sizeof(sm_id_t) * SPIKE);
+	struct payload p = { { 0 } };
+
+	for (int i = 0; i < STEADY; i++) {
+		p.v[0] = i;
+		sm_add(sm, &p);
+	}
+	report("steady state", sm);
+
+	for (int i = 0; i < SPIKE; i++) {
+		p.v[0] = i;
+		spike[i] = sm_add(sm, &p);
+	}
+	report("peak", sm);
+
+	for (int i = 0; i < SPIKE; i++)
+		sm_remove_id(sm, spike[i]);
+	free(spike);
+	for (int i = 0; i < STEADY / 10; i++)
+		sm_add(sm, &p);
+	report("after removal and re-adds", sm);
+
+	sm_compact(sm);
+	report("after sm_compact", sm);
+
+	sm_delete(sm);
+	return 0;
+}
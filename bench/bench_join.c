@@ -0,0 +1,121 @@
+#include "../slotmap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * 2-4 way joins over slotmaps sharing an id space. Map 0 holds every
+ * entity and issues the ids; each other map stores an entity with the given
+ * probability, inserted under map 0's id with sm_emplace_at. The
+ * batched sm_join is compared with iterating the smallest map and probing
+ * the others one id at a time with sm_id_exists/sm_at_id.
+ */
+
+#define COUNT 1000000
+#define MAPS 4
+
+struct payload {
+	double v[4];
+};
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void sum_join(sm_id_t id, void **elements, void *user)
+{
+	(void)id;
+	double *sum = user;
+	*sum += ((struct payload *)elements[0])->v[0] +
+		((struct payload *)elements[1])->v[0];
+}
+
+static double naive_join(slotmap_t *const *maps, size_t count)
+{
+	size_t driver = 0;
+	for (size_t m = 1; m < count; m++) {
+		if (sm_dense_length(maps[m]) < sm_dense_length(maps[driver]))
+			driver = m;
+	}
+
+	double sum = 0.0;
+	void *elements[MAPS];
+	for (index_t i = 0; i < sm_dense_length(maps[driver]); i++) {
+		sm_id_t id = sm_get_id(maps[driver], i);
+		size_t m;
+		for (m = 0; m < count; m++) {
+			if (!sm_id_exists(maps[m], id))
+				break;
+			elements[m] = sm_at_id(maps[m], id);
+		}
+		if (m == count)
+			sum_join(id, elements, &sum);
+	}
+	return sum;
+}
+
+int main(void)
+{
+	static const double selectivities[] = { 1.0, 0.5, 0.1 };
+
+	printf("=== slotmap join ===\n\n");
+	printf("  %-5s %-12s %12s %12s %8s\n", "ways", "selectivity",
+	       "probe ms", "sm_join ms", "speedup");
+
+	srand(42);
+	for (size_t s = 0; s < sizeof(selectivities) / sizeof(*selectivities);
+	     s++) {
+		double selectivity = selectivities[s];
+
+		slotmap_t *maps[MAPS];
+		sm_id_t *ids = malloc(sizeof(sm_id_t) * COUNT);
+		struct payload p = { { 0 } };
+		for (size_t m = 0; m < MAPS; m++)
+			maps[m] = sm_create(sizeof(struct payload));
+		for (index_t i = 0; i < COUNT; i++) {
+			p.v[0] = (double)i;
+			ids[i] = sm_add(maps[0], &p);
+		}
+		/* shuffle so the component maps' dense order differs */
+		for (index_t i = COUNT - 1; i > 0; i--) {
+			index_t j = ((index_t)rand() * RAND_MAX + rand()) %
+				    (i + 1);
+			sm_id_t tmp = ids[i];
+			ids[i] = ids[j];
+			ids[j] = tmp;
+		}
+		for (size_t m = 1; m < MAPS; m++) {
+			for (index_t i = 0; i < COUNT; i++) {
+				if ((double)rand() / RAND_MAX < selectivity) {
+					p.v[0] = (double)ids[i].map_index;
+					*(struct payload *)sm_emplace_at(
+						maps[m], ids[i]) = p;
+				}
+			}
+		}
+
+		for (size_t ways = 2; ways <= MAPS; ways++) {
+			double start = now();
+			double naive_sum = naive_join(maps, ways);
+			double naive_time = now() - start;
+
+			double join_sum = 0.0;
+			start = now();
+			sm_join(maps, ways, sum_join, &join_sum);
+			double join_time = now() - start;
+
+			printf("  %-5zu %-12.2f %12.2f %12.2f %7.2fx%s\n", ways,
+			       selectivity, naive_time * 1e3, join_time * 1e3,
+			       naive_time / join_time,
+			       naive_sum == join_sum ? "" : " (mismatch)");
+		}
+
+		for (size_t m = 0; m < MAPS; m++)
+			sm_delete(maps[m]);
+		free(ids);
+	}
+	return 0;
+}
@@ -4,6 +4,9 @@ make
 # Build and run tests
 make test
 
+# Build and run benchmarks
+# make bench
+
 # Clean all build artifacts
 # make clean
 
@@ -1,4 +1,5 @@
 #include "dynamic_array.h"
+#include "array_alloc.h"
 
 #include <assert.h>
 #include <stddef.h>
@@ -11,16 +12,30 @@ struct DynamicArray {
 	index_t length;
 	index_t capacity;
 	size_t element_size;
+	size_t stride;
+	size_t alignment;
 };
 
 dynamic_array_t *da_create(size_t element_size)
 {
+	return da_create_aligned(element_size, 0, 0);
+}
+
+dynamic_array_t *da_create_aligned(size_t element_size, size_t alignment,
+				   size_t stride_align)
+{
+	assert((alignment & (alignment - 1)) == 0);
+	assert((stride_align & (stride_align - 1)) == 0);
+
 	dynamic_array_t *da = malloc(sizeof(dynamic_array_t));
 
 	da->element_size = element_size;
+	da->stride = array_stride(element_size, stride_align);
+	da->alignment = alignment;
 	da->length = 0;
 	da->capacity = ARRAY_BASE_COUNT;
-	da->data = malloc(element_size * ARRAY_BASE_COUNT);
+	da->data = array_realloc(NULL, 0, da->stride * ARRAY_BASE_COUNT,
+				 alignment);
 
 	if (!da || !da->data) {
 		fprintf(stderr, "Fatal: Memory allocation failed.\n");
@@ -39,7 +54,7 @@ void da_delete(dynamic_array_t *da)
 
 void *da_at(const dynamic_array_t *da, index_t index)
 {
-	return (void *)((char *)da->data + index * da->element_size);
+	return (void *)((char *)da->data + index * da->stride);
 }
 
 void da_swap_elements(dynamic_array_t *da, index_t index_a, index_t index_b)
@@ -53,7 +68,8 @@ void da_swap_elements(dynamic_array_t *da, index_t index_a, index_t index_b)
 
 void da_reserve(dynamic_array_t *da, index_t capacity)
 {
-	da->data = realloc(da->data, da->element_size * capacity);
+	da->data = array_realloc(da->data, da->stride * da->capacity,
+				 da->stride * capacity, da->alignment);
 	if (!da->data) {
 		fprintf(stderr, "Fatal: Memory allocation failed.\n");
 		fflush(stderr);
@@ -72,19 +88,39 @@ void da_resize(dynamic_array_t *da, index_t new_length)
 
 	if (new_length > da->length) {
 		size_t diff = new_length - da->length;
-		memset(da_at(da, da->length), 0, diff * da->element_size);
+		memset(da_at(da, da->length), 0, diff * da->stride);
 	}
 
 	da->length = new_length;
 }
 
-void da_append(dynamic_array_t *da, const void *data)
+void da_clear(dynamic_array_t *da)
+{
+	da->length = 0;
+}
+
+void *da_emplace_back(dynamic_array_t *da)
+{
+	return da_emplace_back_n(da, 1);
+}
+
+void *da_emplace_back_n(dynamic_array_t *da, index_t count)
 {
-	if (da->length >= da->capacity) {
-		da_reserve(da, da->capacity * ARRAY_RESIZE_FACTOR);
+	index_t capacity = da->capacity;
+	while (da->length + count > capacity) {
+		capacity *= ARRAY_RESIZE_FACTOR;
+	}
+	if (capacity != da->capacity) {
+		da_reserve(da, capacity);
 	}
-	memcpy(da_at(da, da->length), data, da->element_size);
-	da->length++;
+	void *first = da_at(da, da->length);
+	da->length += count;
+	return first;
+}
+
+void da_append(dynamic_array_t *da, const void *data)
+{
+	memcpy(da_emplace_back(da), data, da->element_size);
 }
 
 void da_remove_at(dynamic_array_t *da, index_t index)
@@ -93,7 +129,7 @@ void da_remove_at(dynamic_array_t *da, index_t index)
 		return;
 	void *src = da_at(da, index + 1);
 	void *dst = da_at(da, index);
-	size_t bytes = (da->length - index - 1) * da->element_size;
+	size_t bytes = (da->length - index - 1) * da->stride;
 	if (bytes > 0)
 		memmove(dst, src, bytes);
 
@@ -133,3 +169,8 @@ size_t da_element_size(dynamic_array_t *da)
 {
 	return da->element_size;
 }
+
+size_t da_stride(dynamic_array_t *da)
+{
+	return da->stride;
+}
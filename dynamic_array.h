@@ -3,20 +3,38 @@
 
 #include "base.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef struct DynamicArray dynamic_array_t;
 
 index_t da_length(dynamic_array_t *da);
 index_t da_capacity(dynamic_array_t *da);
 size_t da_element_size(dynamic_array_t *da);
+size_t da_stride(dynamic_array_t *da);
 
 dynamic_array_t *da_create(size_t element_size);
+// alignment: buffer alignment in bytes, stride_align: elements are padded to
+// a multiple of it. Both are powers of two, or 0 for the defaults.
+dynamic_array_t *da_create_aligned(size_t element_size, size_t alignment,
+				   size_t stride_align);
 void da_delete(dynamic_array_t *array);
 void *da_at(const dynamic_array_t *array, index_t index);
 void da_swap_elements(dynamic_array_t *array, index_t index_a, index_t index_b);
 void da_reserve(dynamic_array_t *array, index_t capacity);
 void da_resize(dynamic_array_t *array, index_t length);
+// Sets the length to 0, keeping the capacity.
+void da_clear(dynamic_array_t *array);
 void da_append(dynamic_array_t *array, const void *data);
+// Appends uninitialized elements and returns a pointer to the first one.
+void *da_emplace_back(dynamic_array_t *array);
+void *da_emplace_back_n(dynamic_array_t *array, index_t count);
 void da_remove_at(dynamic_array_t *array, index_t index);
 void da_remove_swap_at(dynamic_array_t *array, index_t index);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,87 @@
+#ifndef DYNAMIC_ARRAY_HPP
+#define DYNAMIC_ARRAY_HPP
+
+#include "dynamic_array.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cutil {
+
+// Owning, move-only wrapper around dynamic_array_t. Elements are stored
+// unpadded at alignof(T), so begin()/end() are plain pointers usable with
+// any algorithm, including the parallel execution policies.
+template <typename T> class DynamicArray {
+	static_assert(std::is_trivially_copyable_v<T>,
+		      "elements are relocated with memcpy");
+
+    public:
+	using value_type = T;
+	using size_type = index_t;
+	using iterator = T *;
+	using const_iterator = const T *;
+
+	static constexpr std::size_t element_size = sizeof(T);
+
+	DynamicArray()
+		: da_(da_create_aligned(element_size, alignof(T), 0))
+	{
+	}
+	~DynamicArray()
+	{
+		if (da_)
+			da_delete(da_);
+	}
+
+	DynamicArray(const DynamicArray &) = delete;
+	DynamicArray &operator=(const DynamicArray &) = delete;
+	// moved-from arrays may only be destroyed or assigned to
+	DynamicArray(DynamicArray &&other) noexcept
+		: da_(std::exchange(other.da_, nullptr))
+	{
+	}
+	DynamicArray &operator=(DynamicArray &&other) noexcept
+	{
+		std::swap(da_, other.da_);
+		return *this;
+	}
+
+	size_type size() const { return da_length(da_); }
+	size_type capacity() const { return da_capacity(da_); }
+	bool empty() const { return size() == 0; }
+
+	T *data() { return static_cast<T *>(da_at(da_, 0)); }
+	const T *data() const { return static_cast<const T *>(da_at(da_, 0)); }
+	T &operator[](size_type index) { return data()[index]; }
+	const T &operator[](size_type index) const { return data()[index]; }
+
+	iterator begin() { return data(); }
+	iterator end() { return data() + size(); }
+	const_iterator begin() const { return data(); }
+	const_iterator end() const { return data() + size(); }
+
+	void reserve(size_type capacity) { da_reserve(da_, capacity); }
+	void resize(size_type length) { da_resize(da_, length); }
+
+	void push_back(const T &value) { emplace_back(value); }
+	template <typename... Args> T &emplace_back(Args &&...args)
+	{
+		return *::new (da_emplace_back(da_))
+			T(std::forward<Args>(args)...);
+	}
+
+	void erase(size_type index) { da_remove_at(da_, index); }
+	// moves the last element into index
+	void swap_erase(size_type index) { da_remove_swap_at(da_, index); }
+
+	dynamic_array_t *get() { return da_; }
+
+    private:
+	dynamic_array_t *da_;
+};
+
+} // namespace cutil
+
+#endif
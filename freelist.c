@@ -1,5 +1,7 @@
 #include "freelist.h"
+#include "array_alloc.h"
 
+#include <assert.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,6 +10,8 @@
 struct FreeList {
 	void *data;
 	size_t element_size;
+	size_t stride;
+	size_t alignment;
 	fl_occup_bool_t *occup;
 	index_t length;
 	index_t capacity;
@@ -21,7 +25,7 @@ int fl_is_occupied(const freelist_t *fl, index_t index)
 
 void *fl_at(const freelist_t *fl, index_t index)
 {
-	return (void *)((char *)fl->data + index * fl->element_size);
+	return (void *)((char *)fl->data + index * fl->stride);
 }
 
 void *fl_at_occup(const freelist_t *fl, index_t index)
@@ -31,8 +35,18 @@ void *fl_at_occup(const freelist_t *fl, index_t index)
 
 freelist_t *fl_create(size_t element_size)
 {
+	return fl_create_aligned(element_size, 0, 0);
+}
+
+freelist_t *fl_create_aligned(size_t element_size, size_t alignment,
+			      size_t stride_align)
+{
+	assert((alignment & (alignment - 1)) == 0);
+	assert((stride_align & (stride_align - 1)) == 0);
+
 	freelist_t *fl = malloc(sizeof(struct FreeList));
-	fl->data = malloc(element_size * ARRAY_BASE_COUNT);
+	size_t stride = array_stride(element_size, stride_align);
+	fl->data = array_realloc(NULL, 0, stride * ARRAY_BASE_COUNT, alignment);
 	fl->occup = calloc(ARRAY_BASE_COUNT, sizeof(fl_occup_bool_t));
 	if (!fl || !fl->data || !fl->occup) {
 		fprintf(stderr, "Fatal: Memory allocation failed.\n");
@@ -40,6 +54,8 @@ freelist_t *fl_create(size_t element_size)
 		abort();
 	}
 	fl->element_size = element_size;
+	fl->stride = stride;
+	fl->alignment = alignment;
 	fl->length = 0;
 	fl->capacity = ARRAY_BASE_COUNT;
 	fl->first_free = 0;
@@ -55,7 +71,8 @@ void fl_delete(freelist_t *fl)
 
 void fl_reserve(freelist_t *fl, index_t capacity)
 {
-	fl->data = realloc(fl->data, fl->element_size * capacity);
+	fl->data = array_realloc(fl->data, fl->stride * fl->capacity,
+				 fl->stride * capacity, fl->alignment);
 	fl->occup = realloc(fl->occup, sizeof(fl_occup_bool_t) * capacity);
 	if (!fl->data || !fl->occup) {
 		free(fl->data);
@@ -70,23 +87,33 @@ void fl_reserve(freelist_t *fl, index_t capacity)
 	}
 }
 
-index_t fl_add(freelist_t *fl, const void *data)
+void *fl_emplace(freelist_t *fl, index_t *index)
 {
-	for (size_t i = 0; i < fl->length; i++) {
+	// every slot below first_free is occupied
+	for (size_t i = fl->first_free; i < fl->length; i++) {
 		if (!fl->occup[i]) {
-			memcpy(fl_at(fl, i), data, fl->element_size);
 			fl->occup[i] = 1;
-			return i;
+			fl->first_free = i + 1;
+			*index = i;
+			return fl_at(fl, i);
 		}
 	}
 	if (fl->length == fl->capacity) {
 		fl_reserve(fl, fl->capacity * ARRAY_RESIZE_FACTOR);
 	}
 	fl->length++;
-	memcpy(fl_at(fl, fl->length - 1), data, fl->element_size);
 	fl->occup[fl->length - 1] = 1;
+	fl->first_free = fl->length;
+
+	*index = fl->length - 1;
+	return fl_at(fl, fl->length - 1);
+}
 
-	return fl->length - 1;
+index_t fl_add(freelist_t *fl, const void *data)
+{
+	index_t index;
+	memcpy(fl_emplace(fl, &index), data, fl->element_size);
+	return index;
 }
 
 void fl_remove_at(freelist_t *fl, index_t index)
@@ -95,6 +122,8 @@ void fl_remove_at(freelist_t *fl, index_t index)
 		return;
 
 	fl->occup[index] = 0;
+	if (index < fl->first_free)
+		fl->first_free = index;
 
 	while (fl->length > 0 && !fl->occup[fl->length - 1]) {
 		fl->length--;
@@ -106,6 +135,15 @@ void fl_remove_at(freelist_t *fl, index_t index)
 	}
 }
 
+void fl_compact(freelist_t *fl)
+{
+	index_t capacity = fl->length > ARRAY_BASE_COUNT ? fl->length :
+							   ARRAY_BASE_COUNT;
+	if (capacity < fl->capacity) {
+		fl_reserve(fl, capacity);
+	}
+}
+
 index_t fl_length(freelist_t *fl)
 {
 	return fl->length;
@@ -121,6 +159,11 @@ size_t fl_element_size(freelist_t *fl)
 	return fl->element_size;
 }
 
+size_t fl_stride(freelist_t *fl)
+{
+	return fl->stride;
+}
+
 fl_occup_bool_t *fl_occup_buffer(freelist_t *fl)
 {
 	return fl->occup;
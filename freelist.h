@@ -3,6 +3,10 @@
 
 #include "base.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #define FL_OCCUPIED INDEX_MAX
 
 typedef char fl_occup_bool_t;
@@ -12,16 +16,31 @@ typedef struct FreeList freelist_t;
 index_t fl_length(freelist_t *fl);
 index_t fl_capacity(freelist_t *fl);
 size_t fl_element_size(freelist_t *fl);
+size_t fl_stride(freelist_t *fl);
 
 fl_occup_bool_t *fl_occup_buffer(freelist_t *fl);
 
 freelist_t *fl_create(size_t element_size);
+// alignment: buffer alignment in bytes, stride_align: elements are padded to
+// a multiple of it. Both are powers of two, or 0 for the defaults.
+freelist_t *fl_create_aligned(size_t element_size, size_t alignment,
+			      size_t stride_align);
 void fl_delete(freelist_t *fl);
 int fl_is_occupied(const freelist_t *fl, index_t index);
 void *fl_at(const freelist_t *fl, index_t index);
 void *fl_at_occup(const freelist_t *fl, index_t index);
 index_t fl_add(freelist_t *fl, const void *data);
+// Occupies a slot without initializing it; returns its storage.
+void *fl_emplace(freelist_t *fl, index_t *index);
 void fl_reserve(freelist_t *fl, index_t capacity);
 void fl_remove_at(freelist_t *fl, index_t index);
+// Shrinks the capacity to fit the length (trailing free slots are already
+// dropped by fl_remove_at). Occupied slots never move, so their indices stay
+// valid.
+void fl_compact(freelist_t *fl);
+
+#ifdef __cplusplus
+}
+#endif
 
 #endif
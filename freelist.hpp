@@ -0,0 +1,81 @@
+#ifndef FREELIST_HPP
+#define FREELIST_HPP
+
+#include "freelist.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cutil {
+
+// Owning, move-only wrapper around freelist_t. Indices stay valid until the
+// element they refer to is erased.
+template <typename T> class FreeList {
+	static_assert(std::is_trivially_copyable_v<T>,
+		      "elements are relocated with memcpy");
+
+    public:
+	using value_type = T;
+	using size_type = index_t;
+
+	static constexpr std::size_t element_size = sizeof(T);
+
+	FreeList() : fl_(fl_create_aligned(element_size, alignof(T), 0)) {}
+	~FreeList()
+	{
+		if (fl_)
+			fl_delete(fl_);
+	}
+
+	FreeList(const FreeList &) = delete;
+	FreeList &operator=(const FreeList &) = delete;
+	// moved-from lists may only be destroyed or assigned to
+	FreeList(FreeList &&other) noexcept
+		: fl_(std::exchange(other.fl_, nullptr))
+	{
+	}
+	FreeList &operator=(FreeList &&other) noexcept
+	{
+		std::swap(fl_, other.fl_);
+		return *this;
+	}
+
+	// one past the last occupied slot
+	size_type size() const { return fl_length(fl_); }
+	size_type capacity() const { return fl_capacity(fl_); }
+
+	bool contains(size_type index) const
+	{
+		return fl_is_occupied(fl_, index);
+	}
+	T *find(size_type index)
+	{
+		return static_cast<T *>(fl_at_occup(fl_, index));
+	}
+	T &operator[](size_type index) { return data()[index]; }
+	const T &operator[](size_type index) const { return data()[index]; }
+
+	size_type insert(const T &value) { return emplace(value); }
+	template <typename... Args> size_type emplace(Args &&...args)
+	{
+		size_type index;
+		::new (fl_emplace(fl_, &index)) T(std::forward<Args>(args)...);
+		return index;
+	}
+
+	void erase(size_type index) { fl_remove_at(fl_, index); }
+	void compact() { fl_compact(fl_); }
+
+	freelist_t *get() { return fl_; }
+
+    private:
+	T *data() const { return static_cast<T *>(fl_at(fl_, 0)); }
+
+	freelist_t *fl_;
+};
+
+} // namespace cutil
+
+#endif
@@ -1,67 +1,170 @@
 #include "slotmap.h"
 #include "dynamic_array.h"
-#include "freelist.h"
 
 #include <assert.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define SM_PREFETCH(addr) __builtin_prefetch(addr)
+#define SM_CTZ64(word) __builtin_ctzll(word)
+#else
+#define SM_PREFETCH(addr) ((void)(addr))
+static int sm_ctz64(uint64_t word)
+{
+	int bit = 0;
+	while (!(word & 1)) {
+		word >>= 1;
+		bit++;
+	}
+	return bit;
+}
+#define SM_CTZ64(word) sm_ctz64(word)
+#endif
+
+// number of driver elements probed together by sm_join
+#define SM_JOIN_BATCH 32
+
+// Sparse record of a slot; occupancy, dense index and generation share a
+// cache line. Occupied slots have an odd generation and hold their dense
+// index, free slots have an even generation.
+typedef struct sm_slot_t {
+	index_t index;
+	gen_t gen;
+} sm_slot_t;
 
 struct SlotMap {
-	freelist_t *index_map;
+	sm_slot_t *slots;
+	index_t slot_count;
+	index_t slot_capacity;
 	dynamic_array_t *dense_to_sparse;
-	dynamic_array_t *generations;
 	dynamic_array_t *data;
+	// one bit per free slot below slot_count; every slot below first_free
+	// is occupied, so free slots are reused lowest index first
+	uint64_t *free_bits;
+	index_t first_free;
+	index_t free_count;
+	// generation new sparse slots start at; covers every slot released by
+	// sm_compact so stale ids never match a reused slot
+	gen_t retired_gen;
+	// one bit per sparse slot plus the ids the set bits' slots held when
+	// first marked, NULL unless enabled with sm_track_dirty
+	uint64_t *dirty_bits;
+	dynamic_array_t *dirty_slots;
 };
 
+#define SM_BITMAP_WORDS(slot_capacity) (((slot_capacity) + 63) / 64)
+
 slotmap_t *sm_create(size_t element_size)
+{
+	return sm_create_aligned(element_size, 0, 0);
+}
+
+slotmap_t *sm_create_aligned(size_t element_size, size_t alignment,
+			     size_t stride_align)
 {
 	slotmap_t *sm = malloc(sizeof(struct SlotMap));
+	sm->slots = malloc(sizeof(sm_slot_t) * ARRAY_BASE_COUNT);
+	sm->free_bits =
+		calloc(SM_BITMAP_WORDS(ARRAY_BASE_COUNT), sizeof(uint64_t));
+	if (!sm || !sm->slots || !sm->free_bits) {
+		fprintf(stderr, "Fatal: Memory allocation failed.\n");
+		fflush(stderr);
+		abort();
+	}
 
-	sm->index_map = fl_create(sizeof(index_t));
-	sm->generations = da_create(sizeof(gen_t));
+	sm->slot_count = 0;
+	sm->slot_capacity = ARRAY_BASE_COUNT;
 	sm->dense_to_sparse = da_create(sizeof(index_t));
-	sm->data = da_create(element_size);
+	sm->data = da_create_aligned(element_size, alignment, stride_align);
+	sm->first_free = 0;
+	sm->free_count = 0;
+	sm->retired_gen = 0;
+	sm->dirty_bits = NULL;
+	sm->dirty_slots = NULL;
 
 	return sm;
 }
 
 void sm_delete(slotmap_t *sm)
 {
-	fl_delete(sm->index_map);
-	da_delete(sm->generations);
+	free(sm->slots);
+	free(sm->free_bits);
 	da_delete(sm->dense_to_sparse);
 	da_delete(sm->data);
+	sm_track_dirty(sm, 0);
 	free(sm);
 }
 
+static int sm_slot_dirty(const slotmap_t *sm, index_t index)
+{
+	return sm->dirty_bits &&
+	       (sm->dirty_bits[index / 64] >> (index % 64)) & 1;
+}
+
+// Must run before the slot changes: the list keeps the id the slot held
+// when first marked, so a removal is still reported after the slot is reused.
+static void sm_mark_slot(slotmap_t *sm, index_t index)
+{
+	if (!sm->dirty_bits || sm_slot_dirty(sm, index))
+		return;
+	sm->dirty_bits[index / 64] |= (uint64_t)1 << (index % 64);
+	sm_id_t marked = { index, sm->slots[index].gen };
+	da_append(sm->dirty_slots, &marked);
+}
+
+void sm_track_dirty(slotmap_t *sm, int enable)
+{
+	if (enable && !sm->dirty_bits) {
+		sm->dirty_bits = calloc(SM_BITMAP_WORDS(sm->slot_capacity),
+					sizeof(uint64_t));
+		if (!sm->dirty_bits) {
+			fprintf(stderr, "Fatal: Memory allocation failed.\n");
+			fflush(stderr);
+			abort();
+		}
+		sm->dirty_slots = da_create(sizeof(sm_id_t));
+	} else if (!enable && sm->dirty_bits) {
+		free(sm->dirty_bits);
+		da_delete(sm->dirty_slots);
+		sm->dirty_bits = NULL;
+		sm->dirty_slots = NULL;
+	}
+}
+
+static sm_slot_t *sm_slot(const slotmap_t *sm, sm_id_t id)
+{
+	if (id.map_index >= sm->slot_count)
+		return NULL;
+	sm_slot_t *slot = &sm->slots[id.map_index];
+	// free slots have even generations, so this also checks occupancy
+	return slot->gen == id.gen ? slot : NULL;
+}
+
 int sm_id_exists(const slotmap_t *sm, sm_id_t id)
 {
-	index_t *index = (index_t *)fl_at_occup(sm->index_map, id.map_index);
-	if (index && *(gen_t *)da_at(sm->generations, id.map_index) == id.gen) {
-		return 1;
-	};
-	return 0;
+	return sm_slot(sm, id) != NULL;
 }
 
 index_t sm_get_index(const slotmap_t *sm, sm_id_t id)
 {
-	index_t *index = (index_t *)fl_at_occup(sm->index_map, id.map_index);
-	if (!index ||
-	    *(gen_t *)da_at(sm->generations, id.map_index) != id.gen) {
+	sm_slot_t *slot = sm_slot(sm, id);
+	if (!slot) {
 		fprintf(stderr, "Fatal: Invalid ID [index: %zu; gen: %zu].\n",
 			(size_t)id.map_index, (size_t)id.gen);
 		fflush(stderr);
 		abort();
 	}
-	return *index;
+	return slot->index;
 }
 
-sm_id_t sm_get_id(slotmap_t *sm, index_t index)
+sm_id_t sm_get_id(const slotmap_t *sm, index_t index)
 {
 	sm_id_t id;
 	id.map_index = *(index_t *)da_at(sm->dense_to_sparse, index);
-	id.gen = *(gen_t *)da_at(sm->generations, id.map_index);
+	id.gen = sm->slots[id.map_index].gen;
 	return id;
 }
 
@@ -71,15 +174,45 @@ void *sm_at_id(const slotmap_t *sm, sm_id_t id)
 	return da_at(sm->data, index);
 }
 
+void *sm_find_id(const slotmap_t *sm, sm_id_t id)
+{
+	sm_slot_t *slot = sm_slot(sm, id);
+	return slot ? da_at(sm->data, slot->index) : NULL;
+}
+
+void *sm_find_id_mut(slotmap_t *sm, sm_id_t id)
+{
+	sm_slot_t *slot = sm_slot(sm, id);
+	if (!slot)
+		return NULL;
+	sm_mark_slot(sm, id.map_index);
+	return da_at(sm->data, slot->index);
+}
+
 void *sm_at_index(const slotmap_t *sm, index_t index)
 {
 	return da_at(sm->data, index);
 }
 
+void *sm_at_id_mut(slotmap_t *sm, sm_id_t id)
+{
+	void *element = sm_at_id(sm, id);
+	sm_mark_slot(sm, id.map_index);
+	return element;
+}
+
+void sm_mark_dirty(slotmap_t *sm, sm_id_t id)
+{
+	sm_get_index(sm, id);
+	sm_mark_slot(sm, id.map_index);
+}
+
 void sm_swap_elements(slotmap_t *sm, sm_id_t id_a, sm_id_t id_b)
 {
 	da_swap_elements(sm->data, sm_get_index(sm, id_a),
 			 sm_get_index(sm, id_b));
+	sm_mark_slot(sm, id_a.map_index);
+	sm_mark_slot(sm, id_b.map_index);
 }
 
 index_t sm_dense_length(const slotmap_t *sm)
@@ -87,24 +220,179 @@ index_t sm_dense_length(const slotmap_t *sm)
 	return da_length(sm->data);
 }
 
-sm_id_t sm_add(slotmap_t *sm, const void *data)
+index_t sm_sparse_length(const slotmap_t *sm)
+{
+	return sm->slot_count;
+}
+
+index_t sm_sparse_capacity(const slotmap_t *sm)
+{
+	return sm->slot_capacity;
+}
+
+size_t sm_stride(const slotmap_t *sm)
+{
+	return da_stride(sm->data);
+}
+
+static uint64_t *sm_realloc_bits(uint64_t *bits, index_t old_capacity,
+				 index_t capacity)
+{
+	size_t old_words = SM_BITMAP_WORDS(old_capacity);
+	size_t words = SM_BITMAP_WORDS(capacity);
+	bits = realloc(bits, sizeof(uint64_t) * words);
+	if (!bits) {
+		fprintf(stderr, "Fatal: Memory allocation failed.\n");
+		fflush(stderr);
+		abort();
+	}
+	if (words > old_words) {
+		memset(bits + old_words, 0,
+		       sizeof(uint64_t) * (words - old_words));
+	}
+	return bits;
+}
+
+static void sm_reserve_slots(slotmap_t *sm, index_t capacity)
 {
-	da_append(sm->data, data);
-	index_t index = da_length(sm->data) - 1;
+	sm->slots = realloc(sm->slots, sizeof(sm_slot_t) * capacity);
+	if (!sm->slots) {
+		fprintf(stderr, "Fatal: Memory allocation failed.\n");
+		fflush(stderr);
+		abort();
+	}
+	sm->free_bits =
+		sm_realloc_bits(sm->free_bits, sm->slot_capacity, capacity);
+	if (sm->dirty_bits) {
+		sm->dirty_bits = sm_realloc_bits(sm->dirty_bits,
+						 sm->slot_capacity, capacity);
+	}
+	sm->slot_capacity = capacity;
+}
 
+// Returns the lowest free slot, or SM_INVALID_INDEX if there is none.
+static index_t sm_find_free(slotmap_t *sm)
+{
+	size_t words = SM_BITMAP_WORDS(sm->slot_count);
+	size_t w = sm->first_free / 64;
+	if (w >= words)
+		return SM_INVALID_INDEX;
+
+	uint64_t word = sm->free_bits[w] &
+			(~(uint64_t)0 << (sm->first_free % 64));
+	while (!word) {
+		if (++w == words)
+			return SM_INVALID_INDEX;
+		word = sm->free_bits[w];
+	}
+	return w * 64 + SM_CTZ64(word);
+}
+
+static sm_id_t sm_link_dense(slotmap_t *sm, index_t dense_index)
+{
 	sm_id_t id;
-	id.map_index = fl_add(sm->index_map, &index);
+	sm_slot_t *slot;
+	id.map_index = sm_find_free(sm);
+	if (id.map_index != SM_INVALID_INDEX) {
+		sm->free_bits[id.map_index / 64] &=
+			~((uint64_t)1 << (id.map_index % 64));
+		sm->free_count--;
+		slot = &sm->slots[id.map_index];
+	} else {
+		// the caller has reserved room for a new slot
+		id.map_index = sm->slot_count++;
+		slot = &sm->slots[id.map_index];
+		// new slots start at the retired watermark
+		slot->gen = sm->retired_gen;
+	}
+	sm->first_free = id.map_index + 1;
+	sm_mark_slot(sm, id.map_index);
+	slot->index = dense_index;
+	id.gen = ++slot->gen;
 
-	// generations must be at least the size of index_map and 0-initialized
-	index_t index_capacity = fl_capacity(sm->index_map);
-	index_t gen_capactiy = da_capacity(sm->generations);
-	if (gen_capactiy < index_capacity) {
-		da_resize(sm->generations, fl_capacity(sm->index_map));
+	return id;
+}
+
+void *sm_emplace(slotmap_t *sm, sm_id_t *id)
+{
+	return sm_emplace_n(sm, 1, id);
+}
+
+void *sm_emplace_n(slotmap_t *sm, index_t count, sm_id_t *ids)
+{
+	index_t first = da_length(sm->data);
+	void *span = da_emplace_back_n(sm->data, count);
+	index_t *sparse = (index_t *)da_emplace_back_n(sm->dense_to_sparse,
+						       count);
+
+	// grow the sparse table once for the slots free ones can't cover
+	index_t new_slots = count > sm->free_count ? count - sm->free_count :
+						     0;
+	index_t capacity = sm->slot_capacity;
+	while (sm->slot_count + new_slots > capacity) {
+		capacity *= ARRAY_RESIZE_FACTOR;
+	}
+	if (capacity != sm->slot_capacity) {
+		sm_reserve_slots(sm, capacity);
+	}
+
+	for (index_t i = 0; i < count; i++) {
+		ids[i] = sm_link_dense(sm, first + i);
+		sparse[i] = ids[i].map_index;
+	}
+	return span;
+}
+
+void *sm_emplace_at(slotmap_t *sm, sm_id_t id)
+{
+	// the slot must be free and id.gen an occupied (odd) generation
+	if (id.map_index == SM_INVALID_INDEX || !(id.gen & 1) ||
+	    (id.map_index < sm->slot_count &&
+	     (sm->slots[id.map_index].gen & 1))) {
+		fprintf(stderr,
+			"Fatal: Cannot insert at ID [index: %zu; gen: %zu].\n",
+			(size_t)id.map_index, (size_t)id.gen);
+		fflush(stderr);
+		abort();
+	}
+
+	if (id.map_index >= sm->slot_count) {
+		index_t capacity = sm->slot_capacity;
+		while (id.map_index >= capacity) {
+			capacity *= ARRAY_RESIZE_FACTOR;
+		}
+		if (capacity != sm->slot_capacity) {
+			sm_reserve_slots(sm, capacity);
+		}
+		// slots skipped over become free
+		for (index_t i = sm->slot_count; i <= id.map_index; i++) {
+			sm->slots[i].index = SM_INVALID_INDEX;
+			sm->slots[i].gen = sm->retired_gen;
+			sm->free_bits[i / 64] |= (uint64_t)1 << (i % 64);
+			sm->free_count++;
+		}
+		sm->slot_count = id.map_index + 1;
 	}
-	id.gen = *(gen_t *)da_at(sm->generations, id.map_index);
+
+	sm->free_bits[id.map_index / 64] &=
+		~((uint64_t)1 << (id.map_index % 64));
+	sm->free_count--;
+
+	sm_mark_slot(sm, id.map_index);
+	void *element = da_emplace_back(sm->data);
+	sm_slot_t *slot = &sm->slots[id.map_index];
+	slot->index = da_length(sm->data) - 1;
+	slot->gen = id.gen;
 
 	da_append(sm->dense_to_sparse, &id.map_index);
 
+	return element;
+}
+
+sm_id_t sm_add(slotmap_t *sm, const void *data)
+{
+	sm_id_t id;
+	memcpy(sm_emplace(sm, &id), data, da_element_size(sm->data));
 	return id;
 }
 
@@ -115,18 +403,186 @@ void sm_remove_id(slotmap_t *sm, sm_id_t id)
 	index_t id_of_last_dense =
 		*(index_t *)da_at(sm->dense_to_sparse, da_length(sm->data) - 1);
 
-	fl_remove_at(sm->index_map, id.map_index);
-	(*(index_t *)da_at(sm->generations, id.map_index))++;
+	sm_mark_slot(sm, id.map_index);
+	sm_slot_t *slot = &sm->slots[id.map_index];
+	slot->gen++;
+	slot->index = SM_INVALID_INDEX;
+	sm->free_bits[id.map_index / 64] |= (uint64_t)1 << (id.map_index % 64);
+	sm->free_count++;
+	if (id.map_index < sm->first_free) {
+		sm->first_free = id.map_index;
+	}
 
 	if (id.map_index != id_of_last_dense) {
-		*(index_t *)fl_at_occup(sm->index_map, id_of_last_dense) =
-			array_index;
+		sm->slots[id_of_last_dense].index = array_index;
+		sm_mark_slot(sm, id_of_last_dense);
 	}
 
 	da_remove_swap_at(sm->dense_to_sparse, array_index);
 	da_remove_swap_at(sm->data, array_index);
 }
 
+static void sm_shrink_to_fit(dynamic_array_t *da)
+{
+	index_t capacity = da_length(da) > ARRAY_BASE_COUNT ? da_length(da) :
+							      ARRAY_BASE_COUNT;
+	if (capacity < da_capacity(da)) {
+		da_reserve(da, capacity);
+	}
+}
+
+void sm_compact(slotmap_t *sm)
+{
+	// dirty slots are kept until cleared so their removal is still reported
+	index_t length = sm->slot_count;
+	while (length > 0 && !(sm->slots[length - 1].gen & 1) &&
+	       !sm_slot_dirty(sm, length - 1)) {
+		length--;
+	}
+
+	// retire the generations of every released slot
+	for (index_t i = length; i < sm->slot_count; i++) {
+		if (sm->slots[i].gen > sm->retired_gen) {
+			sm->retired_gen = sm->slots[i].gen;
+		}
+		sm->free_bits[i / 64] &= ~((uint64_t)1 << (i % 64));
+	}
+	// every trimmed slot was free
+	sm->free_count -= sm->slot_count - length;
+	sm->slot_count = length;
+	if (sm->first_free > length) {
+		sm->first_free = length;
+	}
+
+	index_t capacity = length > ARRAY_BASE_COUNT ? length :
+						       ARRAY_BASE_COUNT;
+	if (capacity < sm->slot_capacity) {
+		sm_reserve_slots(sm, capacity);
+	}
+	sm_shrink_to_fit(sm->dense_to_sparse);
+	sm_shrink_to_fit(sm->data);
+}
+
+index_t sm_join(slotmap_t *const *maps, size_t count, sm_join_fn fn,
+		void *user)
+{
+	if (count == 0 || count > SM_JOIN_MAX_MAPS) {
+		fprintf(stderr, "Fatal: Invalid join of %zu maps [max: %d].\n",
+			count, SM_JOIN_MAX_MAPS);
+		fflush(stderr);
+		abort();
+	}
+
+	// drive the join from the smallest map
+	size_t driver = 0;
+	for (size_t m = 1; m < count; m++) {
+		if (sm_dense_length(maps[m]) < sm_dense_length(maps[driver]))
+			driver = m;
+	}
+	const slotmap_t *dsm = maps[driver];
+	index_t length = sm_dense_length(dsm);
+	if (length == 0)
+		return 0;
+
+	const index_t *sparse = (const index_t *)da_at(dsm->dense_to_sparse, 0);
+	char *dense = (char *)da_at(dsm->data, 0);
+	size_t stride = da_stride(dsm->data);
+
+	sm_id_t ids[SM_JOIN_BATCH];
+	void *found[SM_JOIN_MAX_MAPS][SM_JOIN_BATCH];
+	int hit[SM_JOIN_BATCH];
+	index_t matches = 0;
+
+	for (index_t base = 0; base < length; base += SM_JOIN_BATCH) {
+		index_t batch = length - base < SM_JOIN_BATCH ? length - base :
+								SM_JOIN_BATCH;
+
+		for (index_t k = 0; k < batch; k++) {
+			ids[k].map_index = sparse[base + k];
+			ids[k].gen = dsm->slots[ids[k].map_index].gen;
+			found[driver][k] = dense + (base + k) * stride;
+			hit[k] = 1;
+		}
+
+		// fetch every sparse record of the batch before probing any
+		for (size_t m = 0; m < count; m++) {
+			if (m == driver)
+				continue;
+			for (index_t k = 0; k < batch; k++) {
+				if (ids[k].map_index < maps[m]->slot_count)
+					SM_PREFETCH(&maps[m]->slots
+							     [ids[k].map_index]);
+			}
+		}
+
+		for (size_t m = 0; m < count; m++) {
+			if (m == driver)
+				continue;
+			for (index_t k = 0; k < batch; k++) {
+				sm_slot_t *slot = hit[k] ? sm_slot(maps[m], ids[k]) :
+							   NULL;
+				if (!slot) {
+					hit[k] = 0;
+					continue;
+				}
+				found[m][k] = da_at(maps[m]->data, slot->index);
+				SM_PREFETCH(found[m][k]);
+			}
+		}
+
+		for (index_t k = 0; k < batch; k++) {
+			if (!hit[k])
+				continue;
+			void *elements[SM_JOIN_MAX_MAPS];
+			for (size_t m = 0; m < count; m++) {
+				elements[m] = found[m][k];
+			}
+			fn(ids[k], elements, user);
+			matches++;
+		}
+	}
+
+	return matches;
+}
+
+index_t sm_dirty_count(const slotmap_t *sm)
+{
+	return sm->dirty_slots ? da_length(sm->dirty_slots) : 0;
+}
+
+index_t sm_foreach_dirty(const slotmap_t *sm, sm_dirty_fn fn, void *user)
+{
+	index_t calls = 0;
+	index_t count = sm_dirty_count(sm);
+	for (index_t i = 0; i < count; i++) {
+		sm_id_t marked = *(sm_id_t *)da_at(sm->dirty_slots, i);
+		sm_slot_t *slot = &sm->slots[marked.map_index];
+		// the id live at the first mark has since been removed
+		if ((marked.gen & 1) && marked.gen != slot->gen) {
+			fn(marked, NULL, user);
+			calls++;
+		}
+		if (slot->gen & 1) {
+			sm_id_t id = { marked.map_index, slot->gen };
+			fn(id, da_at(sm->data, slot->index), user);
+			calls++;
+		}
+	}
+	return calls;
+}
+
+void sm_clear_dirty(slotmap_t *sm)
+{
+	index_t count = sm_dirty_count(sm);
+	for (index_t i = 0; i < count; i++) {
+		index_t index = ((sm_id_t *)da_at(sm->dirty_slots, i))->map_index;
+		sm->dirty_bits[index / 64] = 0;
+	}
+	if (count > 0) {
+		da_clear(sm->dirty_slots);
+	}
+}
+
 sm_id_t sm_invalid_id()
 {
 	sm_id_t id;
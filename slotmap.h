@@ -3,10 +3,15 @@
 
 #include "base.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef size_t gen_t;
 
 #define SM_INVALID_INDEX (index_t)(-1)
 #define SM_INVALID_GENERATION (gen_t)(-1)
+#define SM_JOIN_MAX_MAPS 8
 
 typedef struct sm_id_t sm_id_t;
 
@@ -17,17 +22,79 @@ struct sm_id_t {
 
 typedef struct SlotMap slotmap_t;
 
+// elements[i] points to the joined id's element in the i-th map
+typedef void (*sm_join_fn)(sm_id_t id, void **elements, void *user);
+// element is NULL when the id has been removed
+typedef void (*sm_dirty_fn)(sm_id_t id, void *element, void *user);
+
 slotmap_t *sm_create(size_t element_size);
+// Dense data is aligned to alignment and padded to a multiple of
+// stride_align. Both are powers of two, or 0 for the defaults.
+slotmap_t *sm_create_aligned(size_t element_size, size_t alignment,
+			     size_t stride_align);
 void sm_delete(slotmap_t *sm);
 int sm_id_exists(const slotmap_t *sm, sm_id_t id);
 index_t sm_get_index(const slotmap_t *sm, sm_id_t id);
+sm_id_t sm_get_id(const slotmap_t *sm, index_t index);
 void *sm_at_id(const slotmap_t *sm, sm_id_t id);
+// Like sm_at_id, but returns NULL for invalid ids.
+void *sm_find_id(const slotmap_t *sm, sm_id_t id);
+// Like sm_at_id, but marks the element dirty.
+void *sm_at_id_mut(slotmap_t *sm, sm_id_t id);
+// Like sm_find_id, but marks the element dirty.
+void *sm_find_id_mut(slotmap_t *sm, sm_id_t id);
 void *sm_at_index(const slotmap_t *sm, index_t index);
 index_t sm_dense_length(const slotmap_t *sm);
+// number of sparse slots, free ones included
+index_t sm_sparse_length(const slotmap_t *sm);
+index_t sm_sparse_capacity(const slotmap_t *sm);
+size_t sm_stride(const slotmap_t *sm);
 void sm_swap_elements(slotmap_t *sm, sm_id_t id_a, sm_id_t id_b);
 sm_id_t sm_add(slotmap_t *sm, const void *data);
+// Adds an uninitialized element, stores its id and returns its storage.
+void *sm_emplace(slotmap_t *sm, sm_id_t *id);
+// Adds count uninitialized elements, storing their ids in ids. Returns the
+// first element of the contiguous dense span holding them, laid out at
+// sm_stride. The span is valid until the slotmap is next modified.
+void *sm_emplace_n(slotmap_t *sm, index_t count, sm_id_t *ids);
+// Adds an uninitialized element under an id issued by another slotmap and
+// returns its storage; aborts if the id's slot is occupied here. Stale-id
+// detection is then up to the issuing map, so a map filled this way should
+// not also hand out ids with sm_add.
+void *sm_emplace_at(slotmap_t *sm, sm_id_t id);
 void sm_remove_id(slotmap_t *sm, sm_id_t id);
+// Releases free trailing sparse slots and shrinks all storage to fit.
+// Ids of removed elements stay invalid after their slot is reused.
+void sm_compact(slotmap_t *sm);
+// Calls fn for every id present in all count maps (at most
+// SM_JOIN_MAX_MAPS). Ids match only on equal index and generation, so an
+// entity must be stored under the same id in every map: issue ids from one
+// map and insert them into the others with sm_emplace_at. Ids from separate
+// sm_add calls only line up if all maps saw identical add sequences. The
+// smallest map is iterated and the others are probed in prefetched batches.
+// fn must not modify the maps. Returns the number of matches.
+index_t sm_join(slotmap_t *const *maps, size_t count, sm_join_fn fn,
+		void *user);
+
+// Enables or disables change tracking. While enabled, adding, removing,
+// moving by swap-removal, swapping and sm_mark_dirty/sm_at_id_mut mark an
+// element's slot dirty until sm_clear_dirty.
+void sm_track_dirty(slotmap_t *sm, int enable);
+void sm_mark_dirty(slotmap_t *sm, sm_id_t id);
+index_t sm_dirty_count(const slotmap_t *sm);
+// Calls fn for the changes to every dirty slot, in the order the slots were
+// first marked: with the removed id and NULL if the id the slot held at its
+// first mark is gone, then with the current id and element if the slot is
+// occupied. A slot removed and reused since the last clear yields both.
+// Slots added and removed again in between yield nothing. Returns the number
+// of calls.
+index_t sm_foreach_dirty(const slotmap_t *sm, sm_dirty_fn fn, void *user);
+void sm_clear_dirty(slotmap_t *sm);
 
 sm_id_t sm_invalid_id();
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -0,0 +1,145 @@
+#ifndef SLOTMAP_HPP
+#define SLOTMAP_HPP
+
+#include "slotmap.h"
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cutil {
+
+// Owning, move-only wrapper around slotmap_t. Elements are stored unpadded
+// at alignof(T), so begin()/end() walk the dense range with plain pointers
+// and work with any algorithm, including the parallel execution policies.
+template <typename T> class SlotMap {
+	static_assert(std::is_trivially_copyable_v<T>,
+		      "elements are relocated with memcpy");
+
+    public:
+	using value_type = T;
+	using size_type = index_t;
+	using iterator = T *;
+	using const_iterator = const T *;
+
+	static constexpr std::size_t element_size = sizeof(T);
+
+	// Typed id; handles of maps with different element types don't mix.
+	class Handle {
+	    public:
+		Handle() : id_(sm_invalid_id()) {}
+		explicit Handle(sm_id_t id) : id_(id) {}
+
+		sm_id_t id() const { return id_; }
+
+		friend bool operator==(Handle a, Handle b)
+		{
+			return a.id_.map_index == b.id_.map_index &&
+			       a.id_.gen == b.id_.gen;
+		}
+		friend bool operator!=(Handle a, Handle b) { return !(a == b); }
+
+	    private:
+		sm_id_t id_;
+	};
+
+	SlotMap() : sm_(sm_create_aligned(element_size, alignof(T), 0)) {}
+	~SlotMap()
+	{
+		if (sm_)
+			sm_delete(sm_);
+	}
+
+	SlotMap(const SlotMap &) = delete;
+	SlotMap &operator=(const SlotMap &) = delete;
+	// moved-from maps may only be destroyed or assigned to
+	SlotMap(SlotMap &&other) noexcept
+		: sm_(std::exchange(other.sm_, nullptr))
+	{
+	}
+	SlotMap &operator=(SlotMap &&other) noexcept
+	{
+		std::swap(sm_, other.sm_);
+		return *this;
+	}
+
+	size_type size() const { return sm_dense_length(sm_); }
+	bool empty() const { return size() == 0; }
+
+	bool contains(Handle handle) const
+	{
+		return sm_id_exists(sm_, handle.id());
+	}
+	// Aborts on invalid handles, like sm_at_id. The mutable overloads of
+	// operator[] and find mark the element dirty, like sm_at_id_mut.
+	T &operator[](Handle handle)
+	{
+		return *static_cast<T *>(sm_at_id_mut(sm_, handle.id()));
+	}
+	const T &operator[](Handle handle) const
+	{
+		return *static_cast<const T *>(sm_at_id(sm_, handle.id()));
+	}
+	T *find(Handle handle)
+	{
+		return static_cast<T *>(sm_find_id_mut(sm_, handle.id()));
+	}
+	const T *find(Handle handle) const
+	{
+		return static_cast<const T *>(sm_find_id(sm_, handle.id()));
+	}
+	size_type index_of(Handle handle) const
+	{
+		return sm_get_index(sm_, handle.id());
+	}
+
+	// dense storage, reordered by erase; writes through it are not
+	// tracked, call mark_dirty for them
+	T *data() { return static_cast<T *>(sm_at_index(sm_, 0)); }
+	const T *data() const
+	{
+		return static_cast<const T *>(sm_at_index(sm_, 0));
+	}
+	iterator begin() { return data(); }
+	iterator end() { return data() + size(); }
+	const_iterator begin() const { return data(); }
+	const_iterator end() const { return data() + size(); }
+
+	Handle insert(const T &value) { return emplace(value); }
+	template <typename... Args> Handle emplace(Args &&...args)
+	{
+		sm_id_t id;
+		::new (sm_emplace(sm_, &id)) T(std::forward<Args>(args)...);
+		return Handle(id);
+	}
+
+	void erase(Handle handle) { sm_remove_id(sm_, handle.id()); }
+	void compact() { sm_compact(sm_); }
+
+	void track_dirty(bool enable) { sm_track_dirty(sm_, enable); }
+	void mark_dirty(Handle handle) { sm_mark_dirty(sm_, handle.id()); }
+	size_type dirty_count() const { return sm_dirty_count(sm_); }
+	void clear_dirty() { sm_clear_dirty(sm_); }
+	// fn(Handle, T *) as in sm_foreach_dirty; T * is null for removals
+	template <typename Fn> size_type for_each_dirty(Fn &&fn) const
+	{
+		return sm_foreach_dirty(
+			sm_,
+			[](sm_id_t id, void *element, void *user) {
+				(*static_cast<std::remove_reference_t<Fn> *>(
+					user))(Handle(id),
+					       static_cast<T *>(element));
+			},
+			const_cast<void *>(static_cast<const void *>(&fn)));
+	}
+
+	slotmap_t *get() { return sm_; }
+
+    private:
+	slotmap_t *sm_;
+};
+
+} // namespace cutil
+
+#endif
@@ -1,5 +1,7 @@
+#include "../freelist.h"
 #include "../slotmap.h"
 #include <assert.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -296,6 +298,304 @@ static void test_large_batch(void)
 #undef N
 }
 
+static void test_compact_after_spike(void)
+{
+	TEST("compact after spike keeps survivors, rejects stale");
+#define N 1000
+	slotmap_t *sm = sm_create(sizeof(struct vec2));
+	sm_id_t ids[N];
+	for (int i = 0; i < N; i++)
+		ids[i] = add_vec(sm, i, -i);
+	for (int i = 10; i < N; i++)
+		sm_remove_id(sm, ids[i]);
+	sm_compact(sm);
+	for (int i = 0; i < 10; i++) {
+		ASSERT(sm_id_exists(sm, ids[i]), "survivor lost by compact");
+		ASSERT(get_vec(sm, ids[i])->x == i, "survivor data corrupted");
+	}
+	/* regrow past the released range */
+	sm_id_t new_ids[N];
+	for (int i = 10; i < N; i++)
+		new_ids[i] = add_vec(sm, i * 2.0, 0);
+	for (int i = 10; i < N; i++) {
+		ASSERT(!sm_id_exists(sm, ids[i]), "stale id accepted");
+		ASSERT(sm_id_exists(sm, new_ids[i]), "new id should exist");
+		ASSERT(get_vec(sm, new_ids[i])->x == i * 2.0,
+		       "data mismatch after regrow");
+	}
+	sm_delete(sm);
+	PASS();
+#undef N
+}
+
+static void test_aligned_storage(void)
+{
+	TEST("aligned, padded dense storage survives growth");
+	slotmap_t *sm = sm_create_aligned(sizeof(struct vec2), 64, 32);
+	ASSERT(sm_stride(sm) == 32, "stride not padded");
+	sm_id_t ids[100];
+	for (int i = 0; i < 100; i++) {
+		ids[i] = add_vec(sm, i, i);
+		ASSERT((uintptr_t)sm_at_index(sm, 0) % 64 == 0,
+		       "buffer misaligned after growth");
+	}
+	for (int i = 0; i < 100; i += 2)
+		sm_remove_id(sm, ids[i]);
+	sm_compact(sm);
+	ASSERT((uintptr_t)sm_at_index(sm, 0) % 64 == 0,
+	       "buffer misaligned after shrink");
+	for (int i = 1; i < 100; i += 2)
+		ASSERT(get_vec(sm, ids[i])->x == i, "data corrupted");
+	sm_delete(sm);
+	PASS();
+}
+
+static void test_emplace(void)
+{
+	TEST("emplace single and bulk elements in place");
+	slotmap_t *sm = sm_create(sizeof(struct vec2));
+	sm_id_t id;
+	struct vec2 *v = sm_emplace(sm, &id);
+	v->x = 1.0;
+	v->y = 2.0;
+	ASSERT(sm_id_exists(sm, id), "emplaced id should exist");
+
+	sm_id_t ids[50];
+	struct vec2 *span = sm_emplace_n(sm, 50, ids);
+	for (int i = 0; i < 50; i++) {
+		span[i].x = i;
+		span[i].y = -i;
+	}
+	ASSERT(sm_dense_length(sm) == 51, "wrong dense length");
+	ASSERT(get_vec(sm, id)->y == 2.0, "single emplace data lost");
+	for (int i = 0; i < 50; i++) {
+		ASSERT(sm_id_exists(sm, ids[i]), "bulk id should exist");
+		ASSERT(get_vec(sm, ids[i])->x == i, "bulk data mismatch");
+	}
+	sm_delete(sm);
+	PASS();
+}
+
+struct join_result {
+	int count;
+	int ok;
+};
+
+static void check_join(sm_id_t id, void **elements, void *user)
+{
+	struct join_result *res = user;
+	struct vec2 *a = elements[0], *b = elements[1], *c = elements[2];
+	/* every map stores the entity number in x */
+	if (a->x != b->x || b->x != c->x || (int)a->x % 6 != 0 ||
+	    a->y != (double)id.map_index)
+		res->ok = 0;
+	res->count++;
+}
+
+static void test_join(void)
+{
+	TEST("3-way join yields ids present in every map");
+#define N 120
+	slotmap_t *maps[3];
+	sm_id_t ids[3][N];
+	for (int m = 0; m < 3; m++) {
+		maps[m] = sm_create(sizeof(struct vec2));
+		for (int i = 0; i < N; i++)
+			ids[m][i] = add_vec(maps[m], i, i);
+	}
+	/* map 1 keeps multiples of 2, map 2 multiples of 3 */
+	for (int i = 0; i < N; i++) {
+		if (i % 2)
+			sm_remove_id(maps[1], ids[1][i]);
+		if (i % 3)
+			sm_remove_id(maps[2], ids[2][i]);
+	}
+	struct join_result res = { 0, 1 };
+	index_t matches = sm_join(maps, 3, check_join, &res);
+	ASSERT(matches == N / 6 && res.count == N / 6, "wrong match count");
+	ASSERT(res.ok, "joined elements mismatch");
+	for (int m = 0; m < 3; m++)
+		sm_delete(maps[m]);
+	PASS();
+#undef N
+}
+
+struct dirty_result {
+	int live;
+	int removed;
+	double sum;
+	sm_id_t removed_id;
+};
+
+static void collect_dirty(sm_id_t id, void *element, void *user)
+{
+	struct dirty_result *res = user;
+	if (element) {
+		res->live++;
+		res->sum += ((struct vec2 *)element)->x;
+	} else {
+		res->removed++;
+		res->removed_id = id;
+	}
+}
+
+static void test_dirty_tracking(void)
+{
+	TEST("dirty tracking reports adds, moves and removals");
+	slotmap_t *sm = sm_create(sizeof(struct vec2));
+	sm_id_t ids[10];
+	for (int i = 0; i < 10; i++)
+		ids[i] = add_vec(sm, i, i);
+	ASSERT(sm_dirty_count(sm) == 0, "untracked map reported dirty");
+
+	sm_track_dirty(sm, 1);
+	ASSERT(sm_dirty_count(sm) == 0, "tracking should start clean");
+	((struct vec2 *)sm_at_id_mut(sm, ids[2]))->x = 20.0;
+	sm_mark_dirty(sm, ids[2]); /* marking twice is reported once */
+	sm_remove_id(sm, ids[0]); /* moves ids[9] into dense index 0 */
+	sm_id_t added = add_vec(sm, 100.0, 0);
+
+	struct dirty_result res = { 0, 0, 0.0, { 0, 0 } };
+	index_t count = sm_foreach_dirty(sm, collect_dirty, &res);
+	/* ids[0]'s slot is reused by the add: its removal is still reported */
+	ASSERT(count == 4 && res.live == 3 && res.removed == 1,
+	       "wrong dirty set");
+	ASSERT(sm_dirty_count(sm) == 3, "wrong dirty slot count");
+	ASSERT(res.removed_id.map_index == ids[0].map_index &&
+		       res.removed_id.gen == ids[0].gen,
+	       "removed id not the one despawned");
+	ASSERT(res.sum == 20.0 + 9.0 + 100.0, "wrong dirty elements");
+	(void)added;
+
+	sm_clear_dirty(sm);
+	ASSERT(sm_dirty_count(sm) == 0, "clear left dirty slots");
+	sm_remove_id(sm, ids[9]);
+	res = (struct dirty_result){ 0, 0, 0.0, { 0, 0 } };
+	sm_foreach_dirty(sm, collect_dirty, &res);
+	ASSERT(res.removed == 1, "removal not reported");
+
+	/* compaction keeps the dirty removed slot */
+	for (int i = 1; i < 9; i++)
+		sm_remove_id(sm, ids[i]);
+	sm_compact(sm);
+	res = (struct dirty_result){ 0, 0, 0.0, { 0, 0 } };
+	sm_foreach_dirty(sm, collect_dirty, &res);
+	ASSERT(res.removed == 9 && res.live == 1, "compact lost dirty slots");
+	sm_delete(sm);
+	PASS();
+}
+
+static void test_add_after_spike_then_compact(void)
+{
+	TEST("add after spike reuses low slot so compact shrinks");
+#define N 1000
+	slotmap_t *sm = sm_create(sizeof(struct vec2));
+	sm_id_t ids[N];
+	for (int i = 0; i < N; i++)
+		ids[i] = add_vec(sm, i, 0);
+	for (int i = 10; i < N; i++)
+		sm_remove_id(sm, ids[i]);
+	sm_id_t id = add_vec(sm, -1.0, 0);
+	ASSERT(id.map_index == 10, "lowest free slot not reused");
+	sm_compact(sm);
+	ASSERT(sm_sparse_length(sm) == 11, "sparse table did not shrink");
+	ASSERT(get_vec(sm, id)->x == -1.0, "data mismatch after compact");
+	sm_delete(sm);
+	PASS();
+#undef N
+}
+
+static void test_freelist_compact(void)
+{
+	TEST("freelist compact shrinks capacity, keeps indices");
+#define N 1000
+	freelist_t *fl = fl_create(sizeof(struct vec2));
+	index_t idx[N];
+	for (int i = 0; i < N; i++) {
+		struct vec2 v = { i, -i };
+		idx[i] = fl_add(fl, &v);
+	}
+	/* survivors are every 7th of the first 70 */
+	for (int i = N; i-- > 0;)
+		if (i >= 70 || i % 7)
+			fl_remove_at(fl, idx[i]);
+	index_t before = fl_capacity(fl);
+	fl_compact(fl);
+	ASSERT(fl_capacity(fl) < before, "capacity did not shrink");
+	ASSERT(fl_capacity(fl) == fl_length(fl), "capacity not fitted");
+	for (int i = 0; i < 70; i += 7) {
+		struct vec2 *v = fl_at_occup(fl, idx[i]);
+		ASSERT(v && v->x == i && v->y == -i, "survivor moved or lost");
+	}
+	fl_delete(fl);
+	PASS();
+#undef N
+}
+
+static void test_reuse_keeps_capacity(void)
+{
+	TEST("add reusing a free slot keeps sparse capacity");
+#define N 5120
+	static sm_id_t ids[N];
+	slotmap_t *sm = sm_create(sizeof(struct vec2));
+	for (int i = 0; i < N; i++)
+		ids[i] = add_vec(sm, i, 0);
+	for (int i = 0; i < 5000; i++)
+		sm_remove_id(sm, ids[i]);
+	index_t capacity = sm_sparse_capacity(sm);
+	sm_id_t id = add_vec(sm, -1.0, 0);
+	ASSERT(id.map_index == 0, "lowest free slot not reused");
+	ASSERT(sm_sparse_capacity(sm) == capacity, "capacity grew on reuse");
+	sm_id_t bulk[4999];
+	sm_emplace_n(sm, 4999, bulk);
+	ASSERT(sm_sparse_capacity(sm) == capacity,
+	       "capacity grew on bulk reuse");
+	sm_delete(sm);
+	PASS();
+#undef N
+}
+
+static void count_join(sm_id_t id, void **elements, void *user)
+{
+	int *count = user;
+	if (((struct vec2 *)elements[0])->x == ((struct vec2 *)elements[1])->x &&
+	    ((struct vec2 *)elements[0])->x == (double)id.map_index)
+		(*count)++;
+}
+
+static void test_join_emplace_at(void)
+{
+	TEST("join over components inserted with sm_emplace_at");
+	slotmap_t *maps[2] = { sm_create(sizeof(struct vec2)),
+			       sm_create(sizeof(struct vec2)) };
+	sm_id_t entities[40];
+	for (int i = 0; i < 40; i++)
+		entities[i] = add_vec(maps[0], i, 0);
+	/* component map only holds every 4th entity, out of order */
+	for (int i = 36; i >= 0; i -= 4) {
+		struct vec2 *v = sm_emplace_at(maps[1], entities[i]);
+		v->x = i;
+		v->y = 0;
+	}
+	/* removing and re-adding a component keeps the entity joined */
+	sm_remove_id(maps[1], entities[8]);
+	struct vec2 *v = sm_emplace_at(maps[1], entities[8]);
+	v->x = 8;
+	ASSERT(sm_id_exists(maps[1], entities[8]), "re-added id missing");
+	int count = 0;
+	ASSERT(sm_join(maps, 2, count_join, &count) == 10 && count == 10,
+	       "wrong join over emplace_at ids");
+	/* a later entity still gets its own fresh slot in the component map */
+	sm_remove_id(maps[0], entities[39]);
+	sm_id_t late = add_vec(maps[0], 39, 0);
+	ASSERT(late.map_index == 39, "entity slot not reused");
+	sm_emplace_at(maps[1], late);
+	ASSERT(sm_id_exists(maps[1], late), "late id missing");
+	sm_delete(maps[0]);
+	sm_delete(maps[1]);
+	PASS();
+}
+
 /* ------------------------------------------------------------------ */
 /* Entry point                                                         */
 /* ------------------------------------------------------------------ */
@@ -317,6 +617,15 @@ int main(void)
 	test_generation_increments();
 	test_data_mutation();
 	test_large_batch();
+	test_compact_after_spike();
+	test_freelist_compact();
+	test_aligned_storage();
+	test_add_after_spike_then_compact();
+	test_emplace();
+	test_reuse_keeps_capacity();
+	test_join();
+	test_join_emplace_at();
+	test_dirty_tracking();
 
 	printf("\n%d / %d tests passed.\n", tests_passed, tests_run);
 	return tests_passed == tests_run ? 0 : 1;
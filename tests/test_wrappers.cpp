@@ -0,0 +1,220 @@
+#include "../dynamic_array.hpp"
+#include "../freelist.hpp"
+#include "../slotmap.hpp"
+#include <algorithm>
+#if defined(TEST_PAR_UNSEQ) && __has_include(<execution>)
+#include <execution>
+#define HAVE_PAR_UNSEQ 1
+#endif
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+
+struct vec2 {
+	double x;
+	double y;
+};
+
+struct alignas(64) line {
+	float v[4];
+};
+
+using sm_iterator = cutil::SlotMap<vec2>::iterator;
+static_assert(std::is_same_v<
+	      std::iterator_traits<sm_iterator>::iterator_category,
+	      std::random_access_iterator_tag>);
+static_assert(!std::is_copy_constructible_v<cutil::SlotMap<vec2>>);
+static_assert(std::is_nothrow_move_constructible_v<cutil::SlotMap<vec2>>);
+static_assert(!std::is_convertible_v<cutil::SlotMap<vec2>::Handle,
+				     cutil::SlotMap<line>::Handle>);
+
+static int tests_run = 0;
+static int tests_passed = 0;
+
+#define TEST(name)                       \
+	do {                             \
+		printf("  %-50s", name); \
+		tests_run++;             \
+	} while (0)
+
+#define PASS()                    \
+	do {                      \
+		printf("PASS\n"); \
+		tests_passed++;   \
+	} while (0)
+
+#define FAIL(msg)                           \
+	do {                                \
+		printf("FAIL (%s)\n", msg); \
+	} while (0)
+
+#define ASSERT(cond, msg)          \
+	do {                       \
+		if (!(cond)) {     \
+			FAIL(msg); \
+			return;    \
+		}                  \
+	} while (0)
+
+/* ------------------------------------------------------------------ */
+/* Test cases                                                          */
+/* ------------------------------------------------------------------ */
+
+static void test_dynamic_array(void)
+{
+	TEST("DynamicArray push, index and iterate");
+	cutil::DynamicArray<int> da;
+	for (int i = 0; i < 100; i++)
+		da.push_back(i);
+	ASSERT(da.size() == 100, "wrong size");
+	ASSERT(da[42] == 42, "index mismatch");
+	ASSERT(std::accumulate(da.begin(), da.end(), 0) == 4950,
+	       "iteration mismatch");
+	da.swap_erase(0);
+	ASSERT(da[0] == 99 && da.size() == 99, "swap_erase mismatch");
+	PASS();
+}
+
+static void test_freelist(void)
+{
+	TEST("FreeList insert, erase and reuse");
+	cutil::FreeList<vec2> fl;
+	auto a = fl.insert({ 1.0, 2.0 });
+	auto b = fl.emplace(vec2{ 3.0, 4.0 });
+	fl.erase(a);
+	ASSERT(!fl.contains(a) && fl.find(a) == nullptr, "erased still found");
+	auto c = fl.insert({ 5.0, 6.0 });
+	ASSERT(c == a, "free slot not reused");
+	ASSERT(fl[b].x == 3.0 && fl[c].y == 6.0, "data mismatch");
+	PASS();
+}
+
+static void test_freelist_compact(void)
+{
+	TEST("FreeList compact after spike keeps survivors");
+	cutil::FreeList<vec2> fl;
+	cutil::FreeList<vec2>::size_type idx[1000];
+	for (int i = 0; i < 1000; i++)
+		idx[i] = fl.insert({ double(i), double(-i) });
+	for (int i = 999; i >= 0; i--)
+		if (i >= 70 || i % 7)
+			fl.erase(idx[i]);
+	auto before = fl.capacity();
+	fl.compact();
+	ASSERT(fl.capacity() < before, "capacity did not shrink");
+	for (int i = 0; i < 70; i += 7)
+		ASSERT(fl.contains(idx[i]) && fl[idx[i]].x == i,
+		       "survivor moved or lost");
+	PASS();
+}
+
+static void test_slotmap(void)
+{
+	TEST("SlotMap handles, erase and dense iteration");
+	cutil::SlotMap<vec2> sm;
+	cutil::SlotMap<vec2>::Handle handles[10];
+	for (int i = 0; i < 10; i++)
+		handles[i] = sm.emplace(vec2{ double(i), double(-i) });
+	sm.erase(handles[3]);
+	ASSERT(!sm.contains(handles[3]) && sm.find(handles[3]) == nullptr,
+	       "erased handle still valid");
+	ASSERT(sm.size() == 9, "wrong size");
+	std::for_each(sm.begin(), sm.end(), [](vec2 &v) { v.x *= 2.0; });
+	for (int i = 0; i < 10; i++)
+		if (i != 3)
+			ASSERT(sm[handles[i]].x == 2.0 * i, "data mismatch");
+	PASS();
+}
+
+#ifdef HAVE_PAR_UNSEQ
+static void test_slotmap_par_unseq(void)
+{
+	TEST("SlotMap dense range with par_unseq for_each");
+	cutil::SlotMap<vec2> sm;
+	cutil::SlotMap<vec2>::Handle handles[10000];
+	for (int i = 0; i < 10000; i++)
+		handles[i] = sm.insert({ double(i), 1.0 });
+	std::for_each(std::execution::par_unseq, sm.begin(), sm.end(),
+		      [](vec2 &v) { v.y += v.x; });
+	for (int i = 0; i < 10000; i++)
+		ASSERT(sm[handles[i]].y == i + 1.0, "parallel update lost");
+	PASS();
+}
+#endif
+
+static void test_slotmap_dirty(void)
+{
+	TEST("SlotMap mutable access marks elements dirty");
+	cutil::SlotMap<vec2> sm;
+	cutil::SlotMap<vec2>::Handle handles[4];
+	for (int i = 0; i < 4; i++)
+		handles[i] = sm.insert({ double(i), 0.0 });
+	sm.track_dirty(true);
+	const cutil::SlotMap<vec2> &view = sm;
+	ASSERT(view[handles[0]].x == 0.0 && view.find(handles[1]),
+	       "const access failed");
+	ASSERT(sm.dirty_count() == 0, "const access marked dirty");
+	sm[handles[2]].y = 1.0;
+	sm.find(handles[3])->y = 1.0;
+	sm.erase(handles[0]);
+	int live = 0, removed = 0;
+	sm.for_each_dirty([&](cutil::SlotMap<vec2>::Handle, vec2 *v) {
+		v ? live++ : removed++;
+	});
+	/* erase moved handles[3] into the freed dense index */
+	ASSERT(live == 2 && removed == 1, "wrong dirty set");
+	sm.clear_dirty();
+	ASSERT(sm.dirty_count() == 0, "clear_dirty left entries");
+	PASS();
+}
+
+static void test_slotmap_move(void)
+{
+	TEST("SlotMap move keeps ownership and handles");
+	cutil::SlotMap<vec2> a;
+	auto h = a.insert({ 7.0, 8.0 });
+	cutil::SlotMap<vec2> b(std::move(a));
+	ASSERT(b.contains(h) && b[h].y == 8.0, "handle lost in move");
+	cutil::SlotMap<vec2> c;
+	c = std::move(b);
+	ASSERT(c.contains(h), "handle lost in move assignment");
+	PASS();
+}
+
+static void test_overaligned(void)
+{
+	TEST("SlotMap of over-aligned type");
+	cutil::SlotMap<line> sm;
+	for (int i = 0; i < 100; i++)
+		sm.insert({ { float(i) } });
+	for (const line &l : sm)
+		ASSERT(reinterpret_cast<uintptr_t>(&l) % alignof(line) == 0,
+		       "element misaligned");
+	PASS();
+}
+
+/* ------------------------------------------------------------------ */
+/* Entry point                                                         */
+/* ------------------------------------------------------------------ */
+
+int main(void)
+{
+	printf("=== C++ wrapper tests ===\n\n");
+
+	test_dynamic_array();
+	test_freelist();
+	test_freelist_compact();
+	test_slotmap();
+#ifdef HAVE_PAR_UNSEQ
+	test_slotmap_par_unseq();
+#endif
+	test_slotmap_dirty();
+	test_slotmap_move();
+	test_overaligned();
+
+	printf("\n%d / %d tests passed.\n", tests_passed, tests_run);
+	return tests_passed == tests_run ? 0 : 1;
+}